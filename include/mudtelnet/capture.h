@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace boost::interprocess {
+    class mapped_region;
+}
+
+namespace mudtelnet {
+
+    /*
+     * Capture file layout, all integers little-endian:
+     *   header: the 8 bytes "MTCAP\0\0\1"
+     *   record: u64 timestamp (ns since the unix epoch), u32 connection id, u8 direction,
+     *           u32 length, then length bytes of raw telnet data.
+     * Files are only ever appended to, so several runs can share one file. A record cut short
+     * by a crash is ignored on replay, and SessionRecorder truncates it away before appending,
+     * so later runs stay readable.
+     */
+
+    enum CaptureDirection : uint8_t {
+        Inbound = 0, // bytes received from the client, as given to MudTelnet::receiveData
+        Outbound = 1 // bytes queued for the client by MudTelnet::sendMessage
+    };
+
+    struct CaptureRecord {
+        uint64_t timestamp = 0;
+        uint32_t connection = 0;
+        CaptureDirection direction = Inbound;
+        std::string_view data;
+    };
+
+    // Appends records to a capture file, refusing to open an existing file that isn't one.
+    // Connections opt in with MudTelnet::attachRecorder(), each under its own id. Not thread-safe;
+    // give each thread its own recorder or file when connections are serviced concurrently.
+    class SessionRecorder {
+    public:
+        explicit SessionRecorder(const std::string &path);
+        bool isOpen() const;
+        void record(uint32_t connection, CaptureDirection direction, std::string_view data);
+        void flush();
+    protected:
+        std::ofstream out;
+    };
+
+    // Memory-maps a capture file and walks its records in order. The data views returned
+    // by next() point into the mapping and live as long as the SessionReplay.
+    class SessionReplay {
+    public:
+        explicit SessionReplay(const std::string &path);
+        ~SessionReplay();
+        bool isOpen() const;
+        bool next(CaptureRecord &rec);
+        void rewind();
+    protected:
+        std::unique_ptr<boost::interprocess::mapped_region> region;
+        std::string_view contents;
+        std::size_t position = 0;
+    };
+
+}
@@ -2,7 +2,9 @@
 // Created by volund on 10/21/22.
 //
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <list>
 #include <unordered_map>
@@ -52,7 +54,7 @@ namespace mudtelnet {
         TelnetMsgType msg_type;
         std::string data;
         char8_t codes[2] = {0, 0};
-        std::size_t parse(const std::string& buf);
+        std::size_t parse(std::string_view buf);
         std::string toString() const;
     };
 
@@ -64,7 +66,8 @@ namespace mudtelnet {
         Text = 0,
         Line = 1,
         Prompt = 2,
-        JSON = 3
+        JSON = 3,
+        MXPLine = 4
     };
 
     struct GameMessage {
@@ -73,6 +76,8 @@ namespace mudtelnet {
     };
 
     class MudTelnet;
+    class MXPDefinitions;
+    class SessionRecorder;
     
     class TelnetOption {
     public:
@@ -88,6 +93,7 @@ namespace mudtelnet {
     protected:
         MudTelnet *conn;
         int mtts_count = 0;
+        void subNAWS(const TelnetMessage &msg);
         void subMTTS(const TelnetMessage &msg);
         void subMTTS_0(const std::string& mtts);
         void subMTTS_1(const std::string& mtts);
@@ -111,6 +117,7 @@ namespace mudtelnet {
         bool mccp2 = false, mccp2_active = false, mccp3 = false, mccp3_active = false, telopt_eor = false;
         bool mtts = false, ttype = false, mnes = false, suppress_ga = false, mslp = false;
         bool force_endline = false, linemode = false, mssp = false, mxp = false, mxp_active = false;
+        bool operator==(const TelnetCapabilities&) const = default;
     };
 
     class MudTelnet {
@@ -121,21 +128,35 @@ namespace mudtelnet {
         void sendPrompt(const std::string &txt);
         void sendLine(const std::string &txt);
         void sendText(const std::string &txt);
+        void sendLines(const std::vector<std::string> &lines);
+        void sendMXP(const std::string &txt);
+        void sendMXPLine(const std::string &txt);
         void sendMSSP(const std::vector<std::tuple<std::string, std::string>> &data);
         void sendSub(char8_t op, const std::string& data);
         void sendNegotiate(char8_t command, char8_t option);
+        void receiveData(std::string_view data);
         void handleMessage(const TelnetMessage &msg);
+        void activateMXP();
+        void attachRecorder(SessionRecorder *rec, uint32_t connection);
+        std::string inDataBuffer;
         std::string appDataBuffer;
         std::list<GameMessage> pendingGameMessages;
         std::string outDataBuffer;
         TelnetCapabilities *capabilities;
         std::string mttsLast;
+        const MXPDefinitions *mxpDefinitions = nullptr;
+        // an unfinished IAC SB longer than this is dropped, along with the rest of it as it arrives.
+        std::size_t maxSubnegotiationSize = 32768;
     protected:
         void handleAppData(const TelnetMessage &msg);
         void handleCommand(const TelnetMessage &msg);
         void handleNegotiate(const TelnetMessage &msg);
         void handleSubnegotiate(const TelnetMessage &msg);
         std::unordered_map<char8_t, TelnetOption> handlers;
+        SessionRecorder *recorder = nullptr;
+        uint32_t connectionId = 0;
+        std::size_t subScanned = 0;
+        bool discardingSub = false;
     };
 
 }
\ No newline at end of file
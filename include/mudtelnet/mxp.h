@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace mudtelnet {
+
+    enum MXPMode : uint8_t {
+        OpenLine = 0,
+        SecureLine = 1,
+        LockedLine = 2,
+        ResetMode = 3,
+        TempSecure = 4,
+        LockOpen = 5,
+        LockSecure = 6,
+        LockLocked = 7
+    };
+
+    // The ESC [ <n> z sequence which switches the client into the given mode.
+    std::string mxpMode(MXPMode mode);
+
+    class MXPDefinitions;
+
+    // Removes MXP tags from txt and decodes entities, leaving what an MXP client would have displayed.
+    // Handles the standard entities (&lt; &gt; &amp; &quot;), numeric ones (&#NN; &#xNN;) and any
+    // registered in definitions. A '<' that doesn't open a tag is kept as text.
+    std::string stripMXP(std::string_view txt, const MXPDefinitions *definitions = nullptr);
+
+    // Escapes <, > and & so untrusted text, such as player names or input, can be embedded in
+    // MXP markup and is displayed literally. stripMXP() turns it back into the original text.
+    std::string mxpEscape(std::string_view txt);
+
+    // A set of <!ELEMENT> / <!ENTITY> definitions, built once and sent verbatim to every client
+    // when MXP activates. Each definition is compiled into its own secure line as it is added.
+    class MXPDefinitions {
+    public:
+        void addElement(const std::string &name, const std::string &definition,
+                        const std::string &attributes = "", const std::string &flag = "");
+        void addEntity(const std::string &name, const std::string &value);
+        const std::string& compiled() const;
+        bool empty() const;
+        const std::string* entity(std::string_view name) const;
+    protected:
+        void addLine(const std::string &line);
+        std::string data;
+        std::map<std::string, std::string, std::less<>> entities;
+    };
+
+}
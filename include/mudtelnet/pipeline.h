@@ -0,0 +1,57 @@
+#pragma once
+#include "mudtelnet/mudtelnet.h"
+#include "mudtelnet/queue.h"
+#include <atomic>
+#include <functional>
+
+namespace mudtelnet {
+
+    /*
+     * Splits one connection between a network thread and the game thread.
+     *
+     * The network thread owns the MudTelnet: it feeds received bytes to receiveData(), which
+     * parses them and answers negotiation on the spot, and it writes whatever takeOutput()
+     * returns to the socket. Completed GameMessages and capability changes are handed to the
+     * game thread through lock-free queues, and the game thread's outgoing messages come back
+     * the same way to be encoded on the network side.
+     *
+     * Network thread: setWakeup(), receiveData(), takeOutput(), backlog(), telnet().
+     * Game thread: pollMessage(), pollCapabilities(), send().
+     *
+     * The wakeup callback runs on the game thread whenever the network side has work: output
+     * was queued, or the game made room for input that was held back. It should only post to
+     * the network thread's event loop (e.g. write an eventfd or asio::post a takeOutput() call).
+     * Without one, the network thread must call takeOutput() on a timer instead.
+     *
+     * When the game falls behind, input waits on the network side; backlog() reports how much,
+     * so the network thread can stop reading from the socket until it drains.
+     */
+    class TelnetPipeline {
+    public:
+        explicit TelnetPipeline(std::size_t queueCapacity = 1024);
+        TelnetPipeline(const TelnetPipeline&) = delete;
+        TelnetPipeline& operator=(const TelnetPipeline&) = delete;
+
+        void setWakeup(std::function<void()> callback);
+        void receiveData(std::string_view data);
+        std::string takeOutput();
+        std::size_t backlog() const;
+        MudTelnet& telnet();
+
+        bool pollMessage(GameMessage &msg);
+        bool pollCapabilities(TelnetCapabilities &caps);
+        bool send(GameMessage msg);
+    protected:
+        void publish();
+        void encode(const GameMessage &msg);
+        void signal();
+        TelnetCapabilities capabilities, published;
+        MudTelnet protocol;
+        SpscQueue<GameMessage> toGame, toNetwork;
+        SpscQueue<TelnetCapabilities> capabilityUpdates;
+        bool capabilitiesPending = true;
+        std::function<void()> wakeup;
+        std::atomic<bool> signalled{false}, gameBehind{false};
+    };
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace mudtelnet {
+
+    // Bounded lock-free single-producer/single-consumer ring buffer. Exactly one thread may
+    // call push() and exactly one (possibly different) thread may call pop().
+    template<typename T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(std::size_t capacity = 1024) {
+            std::size_t size = 2;
+            while(size < capacity) size <<= 1;
+            slots.resize(size);
+            mask = size - 1;
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        // Returns false, leaving item untouched, if the queue is full.
+        bool push(T &item) {
+            auto t = tail.load(std::memory_order_relaxed);
+            if(t - headCache > mask) {
+                headCache = head.load(std::memory_order_acquire);
+                if(t - headCache > mask) return false;
+            }
+            slots[t & mask] = std::move(item);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool push(T &&item) {
+            return push(item);
+        }
+
+        // Returns false if the queue is empty.
+        bool pop(T &out) {
+            auto h = head.load(std::memory_order_relaxed);
+            if(h == tailCache) {
+                tailCache = tail.load(std::memory_order_acquire);
+                if(h == tailCache) return false;
+            }
+            out = std::move(slots[h & mask]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Only a hint when called from the producer side.
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        std::size_t capacity() const {
+            return mask + 1;
+        }
+
+    protected:
+        static constexpr std::size_t cacheLine = 64;
+        std::vector<T> slots;
+        std::size_t mask;
+        // consumer side
+        alignas(cacheLine) std::atomic<std::size_t> head{0};
+        std::size_t tailCache = 0;
+        // producer side
+        alignas(cacheLine) std::atomic<std::size_t> tail{0};
+        std::size_t headCache = 0;
+    };
+
+}
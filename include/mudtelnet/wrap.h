@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+namespace mudtelnet {
+
+    // Returns the byte length of the escape sequence starting at pos, or 0 if there isn't one.
+    // Handles CSI (ESC [ ... final), OSC (ESC ] ... BEL or ESC \) and two-byte ESC sequences.
+    std::size_t escapeLength(std::string_view txt, std::size_t pos);
+
+    // Number of terminal columns the text occupies. Escape sequences count as nothing,
+    // UTF-8 is decoded and wide (CJK, emoji) / zero-width (combining) codepoints are accounted for.
+    std::size_t displayWidth(std::string_view txt);
+
+    struct WrapOptions {
+        int width = 78;
+        int indent = 0; // spaces before the first line of each paragraph.
+        int hangingIndent = 0; // spaces before every continuation line.
+        bool operator==(const WrapOptions&) const = default;
+    };
+
+    // Word-wraps txt into lines no wider than options.width columns. Newlines in txt begin new
+    // paragraphs, though a single trailing newline adds no empty line. Words too long for a line are
+    // broken. Returned lines have no line endings.
+    std::vector<std::string> wrapText(std::string_view txt, const WrapOptions &options);
+
+    // Splits lines into pages of at most height - reserve lines each, leaving reserve lines free for
+    // a "more" prompt. Colours still active at the end of a page are re-applied at the start of the next.
+    std::vector<std::vector<std::string>> paginate(const std::vector<std::string> &lines, int height, int reserve = 1);
+
+    // Memoizes wrapText() per (message, options), so a message broadcast to many clients is only
+    // wrapped once per distinct window width.
+    class WrapCache {
+    public:
+        explicit WrapCache(std::size_t maxMessages = 256);
+        // The returned reference stays valid until clear() is called or the cache fills and resets.
+        const std::vector<std::string>& wrap(std::string_view txt, const WrapOptions &options);
+        void clear();
+        std::size_t size() const;
+    protected:
+        struct StringHash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+        };
+        struct Entry {
+            WrapOptions options;
+            std::vector<std::string> lines;
+        };
+        std::size_t maxMessages;
+        std::unordered_map<std::string, std::list<Entry>, StringHash, std::equal_to<>> entries;
+    };
+
+}
@@ -0,0 +1,138 @@
+#include "mudtelnet/capture.h"
+#include <chrono>
+#include <filesystem>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace mudtelnet {
+
+    namespace {
+        const char captureMagic[8] = {'M', 'T', 'C', 'A', 'P', 0, 0, 1};
+        const std::size_t recordHeaderSize = 8 + 4 + 1 + 4;
+
+        void putInt(char *dest, uint64_t value, std::size_t bytes) {
+            for(std::size_t i = 0; i < bytes; i++) {
+                dest[i] = static_cast<char>(value >> (8 * i));
+            }
+        }
+
+        uint64_t getInt(const char *src, std::size_t bytes) {
+            uint64_t value = 0;
+            for(std::size_t i = 0; i < bytes; i++) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(src[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        // Returns the length of the valid prefix of an existing capture: the header plus every complete
+        // record. Returns 0 for a file with only part of a header, and npos if it isn't a capture at all.
+        std::size_t validLength(const std::string &path, std::size_t size) {
+            std::ifstream in(path, std::ios::binary);
+            char magic[sizeof(captureMagic)];
+            if(!in.read(magic, sizeof(magic))) {
+                auto got = static_cast<std::size_t>(in.gcount());
+                return std::string_view(magic, got) == std::string_view(captureMagic, got) ? 0 : std::string::npos;
+            }
+            if(std::string_view(magic, sizeof(magic)) != std::string_view(captureMagic, sizeof(captureMagic))) {
+                return std::string::npos;
+            }
+
+            std::size_t valid = sizeof(captureMagic);
+            char header[recordHeaderSize];
+            while(size - valid >= recordHeaderSize) {
+                in.seekg(static_cast<std::streamoff>(valid));
+                if(!in.read(header, sizeof(header))) break;
+                auto length = getInt(header + 13, 4);
+                if(size - valid - recordHeaderSize < length) break;
+                valid += recordHeaderSize + length;
+            }
+            return valid;
+        }
+    }
+
+    SessionRecorder::SessionRecorder(const std::string &path) {
+        std::error_code ec;
+        auto existing = std::filesystem::file_size(path, ec);
+        if(!ec && existing > 0) {
+            // Drop a record left half-written by a crash, or the next run's records would be read as its payload.
+            auto valid = validLength(path, existing);
+            if(valid == std::string::npos) return; // not a capture file; leave it alone.
+            if(valid < existing) std::filesystem::resize_file(path, valid, ec);
+            if(ec) return;
+            existing = valid;
+        }
+        out.open(path, std::ios::binary | std::ios::app);
+        if(out && (ec || existing == 0)) out.write(captureMagic, sizeof(captureMagic));
+    }
+
+    bool SessionRecorder::isOpen() const {
+        return out.is_open() && out.good();
+    }
+
+    void SessionRecorder::record(uint32_t connection, CaptureDirection direction, std::string_view data) {
+        if(!isOpen() || data.empty()) return;
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+        char header[recordHeaderSize];
+        putInt(header, now, 8);
+        putInt(header + 8, connection, 4);
+        putInt(header + 12, direction, 1);
+        putInt(header + 13, data.size(), 4);
+        out.write(header, sizeof(header));
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    void SessionRecorder::flush() {
+        out.flush();
+    }
+
+    SessionReplay::SessionReplay(const std::string &path) {
+        using namespace boost::interprocess;
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        // mapping an empty file fails, and a file without the header isn't ours anyway.
+        if(ec || size < sizeof(captureMagic)) return;
+
+        try {
+            file_mapping file(path.c_str(), read_only);
+            region = std::make_unique<mapped_region>(file, read_only);
+        } catch(const interprocess_exception&) {
+            region.reset();
+            return;
+        }
+
+        std::string_view mapped(static_cast<const char*>(region->get_address()), region->get_size());
+        if(mapped.substr(0, sizeof(captureMagic)) != std::string_view(captureMagic, sizeof(captureMagic))) {
+            region.reset();
+            return;
+        }
+        contents = mapped;
+        position = sizeof(captureMagic);
+    }
+
+    SessionReplay::~SessionReplay() = default;
+
+    bool SessionReplay::isOpen() const {
+        return region != nullptr;
+    }
+
+    bool SessionReplay::next(CaptureRecord &rec) {
+        if(!isOpen() || contents.size() - position < recordHeaderSize) return false;
+        auto header = contents.data() + position;
+        auto length = getInt(header + 13, 4);
+        if(contents.size() - position - recordHeaderSize < length) return false;
+
+        rec.timestamp = getInt(header, 8);
+        rec.connection = static_cast<uint32_t>(getInt(header + 8, 4));
+        rec.direction = static_cast<CaptureDirection>(getInt(header + 12, 1));
+        rec.data = contents.substr(position + recordHeaderSize, length);
+        position += recordHeaderSize + length;
+        return true;
+    }
+
+    void SessionReplay::rewind() {
+        if(isOpen()) position = sizeof(captureMagic);
+    }
+
+}
@@ -1,4 +1,6 @@
 #include "mudtelnet/mudtelnet.h"
+#include "mudtelnet/mxp.h"
+#include "mudtelnet/capture.h"
 #include <boost/algorithm/string.hpp>
 
 namespace mudtelnet {
@@ -12,7 +14,7 @@ namespace mudtelnet {
         const char8_t MTTS = 24;
     }
 
-    std::size_t TelnetMessage::parse(const std::string& buf) {
+    std::size_t TelnetMessage::parse(std::string_view buf) {
         using namespace codes;
         // return early if nothing to do.
         auto available = buf.length();
@@ -152,7 +154,7 @@ namespace mudtelnet {
             case SGA:
             case MSDP:
             case GMCP:
-                //case MXP:
+            case MXP:
                 return true;
             default:
                 return false;
@@ -178,7 +180,7 @@ namespace mudtelnet {
             case SGA:
             case MSDP:
             case GMCP:
-                //case MXP:
+            case MXP:
                 return true;
             default:
                 return false;
@@ -186,7 +188,13 @@ namespace mudtelnet {
     }
 
     void TelnetOption::enableLocal() {
-
+        using namespace codes;
+        switch(code) {
+            case MXP:
+                conn->capabilities->mxp = true;
+                conn->activateMXP();
+                break;
+        }
     }
 
     void TelnetOption::enableRemote() {
@@ -196,11 +204,20 @@ namespace mudtelnet {
                 conn->capabilities->mtts = true;
                 conn->sendSub(code, std::string({1}));
                 break;
+            case NAWS:
+                conn->capabilities->naws = true;
+                break;
         }
     }
 
     void TelnetOption::disableLocal() {
-
+        using namespace codes;
+        switch(code) {
+            case MXP:
+                conn->capabilities->mxp = false;
+                conn->capabilities->mxp_active = false;
+                break;
+        }
     }
 
     void TelnetOption::disableRemote() {
@@ -285,7 +302,26 @@ namespace mudtelnet {
             case MTTS:
                 subMTTS(msg);
                 break;
+            case NAWS:
+                subNAWS(msg);
+                break;
+        }
+    }
+
+    void TelnetOption::subNAWS(const TelnetMessage &msg) {
+        // NAWS is four bytes: width and height as 16-bit big-endian, with any 255 byte doubled.
+        std::string sizes;
+        for(auto it = msg.data.begin(); it != msg.data.end(); it++) {
+            sizes.push_back(*it);
+            if((char8_t)*it == codes::IAC && std::next(it) != msg.data.end() && (char8_t)*std::next(it) == codes::IAC) it++;
         }
+        if(sizes.size() != 4) return;
+
+        auto width = ((char8_t)sizes[0] << 8) | (char8_t)sizes[1];
+        auto height = ((char8_t)sizes[2] << 8) | (char8_t)sizes[3];
+        // 0 means the client doesn't know, so we keep whatever we had.
+        if(width) conn->capabilities->width = width;
+        if(height) conn->capabilities->height = height;
     }
 
     void TelnetOption::subMTTS(const TelnetMessage &msg) {
@@ -447,7 +483,7 @@ namespace mudtelnet {
     MudTelnet::MudTelnet(mudtelnet::TelnetCapabilities *cap) : capabilities(cap) {
         using namespace codes;
 
-        for(const auto &code : {MSSP, SGA, MSDP, GMCP, NAWS, MTTS}) {
+        for(const auto &code : {MSSP, SGA, MSDP, GMCP, MXP, NAWS, MTTS}) {
             auto result = handlers.emplace(code, TelnetOption(this, code));
             if(!result.second) continue;
             auto &h = result.first->second;
@@ -465,7 +501,9 @@ namespace mudtelnet {
     }
 
     void MudTelnet::sendMessage(const mudtelnet::TelnetMessage &data) {
-        outDataBuffer += data.toString();
+        auto out = data.toString();
+        if(recorder) recorder->record(connectionId, Outbound, out);
+        outDataBuffer += out;
     }
 
     void MudTelnet::sendSub(const char8_t op, const std::string &data) {
@@ -510,6 +548,54 @@ namespace mudtelnet {
         else sendText(txt + "\r\n");
     }
 
+    void MudTelnet::sendLines(const std::vector<std::string> &lines) {
+        // Lines from wrapText() and paginate() carry no line endings, so they can be sent as a single chunk.
+        std::string out;
+        for(const auto &l : lines) {
+            out += l;
+            out += "\r\n";
+        }
+        sendText(out);
+    }
+
+    void MudTelnet::sendMXP(const std::string &txt) {
+        if(!capabilities->mxp_active) {
+            sendText(stripMXP(txt, mxpDefinitions));
+            return;
+        }
+        // Secure mode ends at each newline, so every line must open it again.
+        std::string out;
+        bool lineStart = true;
+        for(auto c : txt) {
+            if(lineStart) {
+                out += mxpMode(SecureLine);
+                lineStart = false;
+            }
+            out.push_back(c);
+            if(c == '\n') lineStart = true;
+        }
+        // A secure line runs until its newline. If the text ends mid-line, lock it now so that
+        // whatever is written next on the same line isn't secure too.
+        if(!lineStart) out += mxpMode(LockLocked);
+        sendText(out);
+    }
+
+    void MudTelnet::sendMXPLine(const std::string &txt) {
+        if(boost::algorithm::ends_with(txt, "\r\n")) sendMXP(txt);
+        else sendMXP(txt + "\r\n");
+    }
+
+    void MudTelnet::activateMXP() {
+        sendSub(codes::MXP, "");
+        capabilities->mxp_active = true;
+        if(mxpDefinitions && !mxpDefinitions->empty()) {
+            sendMessage(TelnetMessage{.msg_type=AppData, .data=mxpDefinitions->compiled()});
+        }
+        // Locked is the default mode, so only text sent through sendMXP() is parsed for tags. Untrusted text
+        // placed inside MXP markup still needs mxpEscape().
+        sendMessage(TelnetMessage{.msg_type=AppData, .data=mxpMode(LockLocked)});
+    }
+
     void MudTelnet::sendMSSP(const std::vector<std::tuple<std::string, std::string>> &data) {
         std::vector<std::string> pairs;
         for(auto &p : data) {
@@ -523,6 +609,65 @@ namespace mudtelnet {
         sendMessage(msg);
     }
 
+    void MudTelnet::attachRecorder(SessionRecorder *rec, uint32_t connection) {
+        recorder = rec;
+        connectionId = connection;
+        // The constructor's negotiation is still waiting in outDataBuffer unless the caller already sent it,
+        // so attach before the first write to capture the whole session.
+        if(recorder && !outDataBuffer.empty()) recorder->record(connectionId, Outbound, outDataBuffer);
+    }
+
+    void MudTelnet::receiveData(std::string_view data) {
+        using namespace codes;
+        const char subEndCodes[2] = {static_cast<char>(IAC), static_cast<char>(SE)};
+        const std::string_view subEnd(subEndCodes, 2);
+
+        if(data.empty()) return;
+        if(recorder) recorder->record(connectionId, Inbound, data);
+        inDataBuffer.append(data);
+
+        if(discardingSub) {
+            // skip the rest of an oversized subnegotiation. Only a trailing IAC needs keeping, in case SE follows.
+            auto end = std::string_view(inDataBuffer).find(subEnd);
+            if(end == std::string_view::npos) {
+                auto keep = !inDataBuffer.empty() && (char8_t)inDataBuffer.back() == IAC ? 1 : 0;
+                inDataBuffer.erase(0, inDataBuffer.size() - keep);
+                return;
+            }
+            inDataBuffer.erase(0, end + subEnd.size());
+            discardingSub = false;
+        }
+
+        // Handle every complete message, then drop them from the buffer in one go.
+        std::string_view remaining(inDataBuffer);
+        while(!remaining.empty()) {
+            if(remaining.size() >= 2 && (char8_t)remaining[0] == IAC && (char8_t)remaining[1] == SB) {
+                // Look for the end of a subnegotiation before parsing it, resuming where the previous call
+                // stopped so that a subnegotiation trickling in isn't rescanned from the start every time.
+                auto end = remaining.find(subEnd, std::max<std::size_t>(subScanned, 3));
+                if(end == std::string_view::npos) {
+                    if(remaining.size() > maxSubnegotiationSize) {
+                        auto keep = (char8_t)remaining.back() == IAC ? 1 : 0;
+                        remaining.remove_prefix(remaining.size() - keep);
+                        discardingSub = true;
+                        subScanned = 0;
+                    } else {
+                        // the last byte may be the IAC of IAC SE, so it gets checked again.
+                        subScanned = remaining.size() - 1;
+                    }
+                    break;
+                }
+                subScanned = 0;
+            }
+            TelnetMessage msg;
+            auto used = msg.parse(remaining);
+            if(!used) break;
+            remaining.remove_prefix(used);
+            handleMessage(msg);
+        }
+        inDataBuffer.erase(0, inDataBuffer.size() - remaining.size());
+    }
+
     void MudTelnet::handleMessage(const mudtelnet::TelnetMessage &msg) {
         switch(msg.msg_type) {
             case AppData:
@@ -541,7 +686,7 @@ namespace mudtelnet {
     }
 
     void MudTelnet::handleAppData(const TelnetMessage &msg) {
-        GameMessage g;
+        GameMessage g {.gameMessageType=Line};
         for(const auto& c : msg.data) {
             switch(c) {
                 case '\n':
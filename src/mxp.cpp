@@ -0,0 +1,189 @@
+#include "mudtelnet/mxp.h"
+#include <cctype>
+#include <charconv>
+
+namespace mudtelnet {
+
+    namespace {
+        const std::size_t maxEntityLength = 32;
+
+        // MXP accepts either quote style, so use whichever the value doesn't contain. If it has
+        // both, double quotes are used and any inside the value become &quot;.
+        std::string quoted(const std::string &value) {
+            if(value.find('\'') == std::string::npos) return "'" + value + "'";
+            std::string out = "\"";
+            for(auto c : value) {
+                if(c == '"') out += "&quot;";
+                else out.push_back(c);
+            }
+            out.push_back('"');
+            return out;
+        }
+
+        // Returns the index of the '>' closing the tag that starts at pos, or npos if there's no tag there.
+        std::size_t tagEnd(std::string_view txt, std::size_t pos) {
+            if(pos + 1 >= txt.size()) return std::string_view::npos;
+            auto first = txt[pos + 1];
+            if(!std::isalpha(static_cast<unsigned char>(first)) && first != '/' && first != '!') {
+                return std::string_view::npos;
+            }
+            char quote = 0;
+            for(auto i = pos + 1; i < txt.size(); i++) {
+                if(quote) {
+                    if(txt[i] == quote) quote = 0;
+                } else if(txt[i] == '\'' || txt[i] == '"') {
+                    quote = txt[i];
+                } else if(txt[i] == '>') {
+                    return i;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        void appendUtf8(char32_t cp, std::string &out) {
+            if(cp < 0x80) {
+                out.push_back(static_cast<char>(cp));
+            } else if(cp < 0x800) {
+                out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else if(cp < 0x10000) {
+                out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else {
+                out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
+        }
+
+        // Appends the text for the entity &name; to out, returning false if it isn't one we know.
+        bool decodeEntity(std::string_view name, const MXPDefinitions *definitions, std::string &out) {
+            if(name.empty()) return false;
+            if(name[0] == '#') {
+                auto digits = name.substr(1);
+                int base = 10;
+                if(!digits.empty() && (digits[0] == 'x' || digits[0] == 'X')) {
+                    base = 16;
+                    digits.remove_prefix(1);
+                }
+                uint32_t cp = 0;
+                auto result = std::from_chars(digits.data(), digits.data() + digits.size(), cp, base);
+                if(digits.empty() || result.ec != std::errc() || result.ptr != digits.data() + digits.size()) return false;
+                if(cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return false;
+                appendUtf8(cp, out);
+                return true;
+            }
+            if(name == "lt") out.push_back('<');
+            else if(name == "gt") out.push_back('>');
+            else if(name == "amp") out.push_back('&');
+            else if(name == "quot") out.push_back('"');
+            else if(auto value = definitions ? definitions->entity(name) : nullptr) out += *value;
+            else return false;
+            return true;
+        }
+    }
+
+    std::string mxpMode(MXPMode mode) {
+        return "\x1b[" + std::to_string(mode) + "z";
+    }
+
+    std::string stripMXP(std::string_view txt, const MXPDefinitions *definitions) {
+        std::string out;
+        out.reserve(txt.size());
+        // no tag can close past the last '>', which spares rescanning the tail for every stray '<'.
+        auto lastClose = txt.rfind('>');
+
+        for(std::size_t i = 0; i < txt.size(); i++) {
+            auto c = txt[i];
+            switch(c) {
+                case '<': {
+                    // only <name, </name and <!... open a tag; anything else is just a less-than sign.
+                    auto end = lastClose != std::string_view::npos && i < lastClose ? tagEnd(txt, i) : std::string_view::npos;
+                    if(end == std::string_view::npos) {
+                        out.push_back(c);
+                    } else {
+                        i = end;
+                    }
+                    break;
+                }
+                case '&': {
+                    auto semi = txt.substr(i + 1, maxEntityLength).find(';');
+                    if(semi == std::string_view::npos) {
+                        out.push_back(c);
+                        break;
+                    }
+                    semi += i + 1;
+                    if(decodeEntity(txt.substr(i + 1, semi - i - 1), definitions, out)) {
+                        i = semi;
+                    } else {
+                        out.push_back(c);
+                    }
+                    break;
+                }
+                default:
+                    out.push_back(c);
+                    break;
+            }
+        }
+        return out;
+    }
+
+    std::string mxpEscape(std::string_view txt) {
+        std::string out;
+        out.reserve(txt.size());
+        for(auto c : txt) {
+            switch(c) {
+                case '<':
+                    out += "&lt;";
+                    break;
+                case '>':
+                    out += "&gt;";
+                    break;
+                case '&':
+                    out += "&amp;";
+                    break;
+                default:
+                    out.push_back(c);
+                    break;
+            }
+        }
+        return out;
+    }
+
+    void MXPDefinitions::addElement(const std::string &name, const std::string &definition,
+                                    const std::string &attributes, const std::string &flag) {
+        std::string line = "<!ELEMENT " + name + " " + quoted(definition);
+        if(!attributes.empty()) line += " ATT=" + quoted(attributes);
+        if(!flag.empty()) line += " FLAG=" + quoted(flag);
+        line += ">";
+        addLine(line);
+    }
+
+    void MXPDefinitions::addEntity(const std::string &name, const std::string &value) {
+        entities[name] = value;
+        addLine("<!ENTITY " + name + " " + quoted(value) + ">");
+    }
+
+    void MXPDefinitions::addLine(const std::string &line) {
+        // Secure mode only lasts until the end of the line, so every definition gets its own.
+        data += mxpMode(SecureLine);
+        data += line;
+        data += "\r\n";
+    }
+
+    const std::string& MXPDefinitions::compiled() const {
+        return data;
+    }
+
+    bool MXPDefinitions::empty() const {
+        return data.empty();
+    }
+
+    const std::string* MXPDefinitions::entity(std::string_view name) const {
+        auto found = entities.find(name);
+        return found == entities.end() ? nullptr : &found->second;
+    }
+
+}
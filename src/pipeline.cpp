@@ -0,0 +1,111 @@
+#include "mudtelnet/pipeline.h"
+#include <utility>
+
+namespace mudtelnet {
+
+    TelnetPipeline::TelnetPipeline(std::size_t queueCapacity) : protocol(&capabilities), toGame(queueCapacity),
+                                                                toNetwork(queueCapacity), capabilityUpdates(16) {
+        published = capabilities;
+    }
+
+    void TelnetPipeline::setWakeup(std::function<void()> callback) {
+        wakeup = std::move(callback);
+    }
+
+    std::size_t TelnetPipeline::backlog() const {
+        return protocol.pendingGameMessages.size();
+    }
+
+    MudTelnet& TelnetPipeline::telnet() {
+        return protocol;
+    }
+
+    void TelnetPipeline::receiveData(std::string_view data) {
+        protocol.receiveData(data);
+        publish();
+    }
+
+    std::string TelnetPipeline::takeOutput() {
+        // cleared before draining, so anything sent after this point signals again.
+        signalled.store(false);
+        GameMessage msg;
+        while(toNetwork.pop(msg)) encode(msg);
+        // retry anything the game side had no room for last time.
+        publish();
+        return std::exchange(protocol.outDataBuffer, {});
+    }
+
+    void TelnetPipeline::publish() {
+        auto &pending = protocol.pendingGameMessages;
+        auto flush = [&] {
+            while(!pending.empty() && toGame.push(pending.front())) {
+                pending.pop_front();
+            }
+        };
+        // if the game falls behind, messages wait here until it catches up. The flag is raised before
+        // trying once more, so a pollMessage() that frees a slot either lets that retry through or sees
+        // the flag and wakes us.
+        flush();
+        if(!pending.empty()) {
+            gameBehind.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            flush();
+        }
+        if(pending.empty()) gameBehind.store(false);
+
+        if(capabilities != published) {
+            published = capabilities;
+            capabilitiesPending = true;
+        }
+        if(capabilitiesPending) {
+            auto snapshot = published;
+            if(capabilityUpdates.push(snapshot)) capabilitiesPending = false;
+        }
+    }
+
+    void TelnetPipeline::encode(const GameMessage &msg) {
+        switch(msg.gameMessageType) {
+            case Text:
+                protocol.sendText(msg.data);
+                break;
+            case Line:
+                protocol.sendLine(msg.data);
+                break;
+            case Prompt:
+                protocol.sendPrompt(msg.data);
+                break;
+            case JSON:
+                protocol.sendGMCP(msg.data);
+                break;
+            case MXPLine:
+                protocol.sendMXPLine(msg.data);
+                break;
+        }
+    }
+
+    bool TelnetPipeline::pollMessage(GameMessage &msg) {
+        if(!toGame.pop(msg)) return false;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(gameBehind.load()) signal();
+        return true;
+    }
+
+    bool TelnetPipeline::pollCapabilities(TelnetCapabilities &caps) {
+        // only the newest snapshot matters.
+        bool found = false;
+        while(capabilityUpdates.pop(caps)) found = true;
+        return found;
+    }
+
+    bool TelnetPipeline::send(GameMessage msg) {
+        if(!toNetwork.push(msg)) return false;
+        signal();
+        return true;
+    }
+
+    void TelnetPipeline::signal() {
+        // one wakeup per takeOutput(), however many messages are sent before it runs.
+        if(!signalled.exchange(true) && wakeup) wakeup();
+    }
+
+}
@@ -0,0 +1,346 @@
+#include "mudtelnet/wrap.h"
+#include <algorithm>
+#include <charconv>
+
+namespace mudtelnet {
+
+    namespace {
+        struct Range {
+            char32_t first, last;
+        };
+
+        const Range zeroWidth[] = {
+                {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A},
+                {0x064B, 0x065F}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E},
+                {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x202A, 0x202E},
+                {0x2060, 0x2064}, {0x20D0, 0x20FF}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F},
+                {0xFEFF, 0xFEFF}, {0xE0100, 0xE01EF}
+        };
+
+        const Range wide[] = {
+                {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC},
+                {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x26AA, 0x26AB},
+                {0x26BD, 0x26BE}, {0x26C4, 0x26C5}, {0x26F2, 0x26F5}, {0x2705, 0x2705},
+                {0x270A, 0x270B}, {0x274C, 0x274C}, {0x2753, 0x2755}, {0x2795, 0x2797},
+                {0x2B1B, 0x2B1C}, {0x2E80, 0x303E}, {0x3041, 0x33FF}, {0x3400, 0x4DBF},
+                {0x4E00, 0x9FFF}, {0xA000, 0xA4CF}, {0xA960, 0xA97F}, {0xAC00, 0xD7A3},
+                {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F}, {0xFF00, 0xFF60},
+                {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4}, {0x17000, 0x18CFF}, {0x1B000, 0x1B2FF},
+                {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A},
+                {0x1F200, 0x1F251}, {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB},
+                {0x1F90C, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD}
+        };
+
+        template<std::size_t N>
+        bool inTable(const Range (&table)[N], char32_t cp) {
+            auto found = std::upper_bound(std::begin(table), std::end(table), cp,
+                                          [](char32_t c, const Range &r) { return c < r.first; });
+            if(found == std::begin(table)) return false;
+            --found;
+            return cp <= found->last;
+        }
+
+        int codepointWidth(char32_t cp) {
+            if(cp < 0x20 || (cp >= 0x7F && cp < 0xA0)) return 0;
+            if(cp < 0x300) return 1;
+            if(inTable(zeroWidth, cp)) return 0;
+            if(inTable(wide, cp)) return 2;
+            return 1;
+        }
+
+        // Measures the single unit at pos: an escape sequence, or one UTF-8 encoded codepoint.
+        // Malformed UTF-8 is treated as one column per byte so that nothing is silently lost.
+        std::size_t nextUnit(std::string_view txt, std::size_t pos, int &width) {
+            if(auto esc = escapeLength(txt, pos)) {
+                width = 0;
+                return esc;
+            }
+            auto c = static_cast<unsigned char>(txt[pos]);
+            if(c < 0x80) {
+                width = codepointWidth(c);
+                return 1;
+            }
+            std::size_t len;
+            char32_t cp;
+            if((c & 0xE0) == 0xC0) {
+                len = 2;
+                cp = c & 0x1F;
+            } else if((c & 0xF0) == 0xE0) {
+                len = 3;
+                cp = c & 0x0F;
+            } else if((c & 0xF8) == 0xF0) {
+                len = 4;
+                cp = c & 0x07;
+            } else {
+                width = 1;
+                return 1;
+            }
+            if(pos + len > txt.size()) {
+                width = 1;
+                return 1;
+            }
+            for(std::size_t i = 1; i < len; i++) {
+                auto cont = static_cast<unsigned char>(txt[pos + i]);
+                if((cont & 0xC0) != 0x80) {
+                    width = 1;
+                    return 1;
+                }
+                cp = (cp << 6) | (cont & 0x3F);
+            }
+            width = codepointWidth(cp);
+            return len;
+        }
+
+        // The colour and attributes left active by a run of SGR sequences, one setting per attribute so
+        // it stays bounded however many changes the text makes.
+        struct SgrState {
+            enum Group { Foreground, Background, Intensity, Italic, Underline, Blink, Reverse, Conceal, Strike, Groups };
+            std::string groups[Groups];
+
+            void apply(std::string_view params) {
+                std::vector<int> codes;
+                std::size_t start = 0;
+                while(true) {
+                    auto end = params.find(';', start);
+                    auto part = params.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+                    int value = 0;
+                    std::from_chars(part.data(), part.data() + part.size(), value);
+                    codes.push_back(value);
+                    if(end == std::string_view::npos) break;
+                    start = end + 1;
+                }
+
+                for(std::size_t i = 0; i < codes.size(); i++) {
+                    auto c = codes[i];
+                    if(c == 38 || c == 48) {
+                        // extended colour: 38;5;n or 38;2;r;g;b
+                        auto len = i + 1 < codes.size() && codes[i + 1] == 2 ? 5 : 3;
+                        if(i + len > codes.size()) break;
+                        std::string value;
+                        for(auto j = i; j < i + len; j++) value += (j == i ? "" : ";") + std::to_string(codes[j]);
+                        groups[c == 38 ? Foreground : Background] = value;
+                        i += len - 1;
+                    } else if(c == 0) {
+                        for(auto &g : groups) g.clear();
+                    } else if((c >= 30 && c <= 37) || (c >= 90 && c <= 97)) {
+                        groups[Foreground] = std::to_string(c);
+                    } else if((c >= 40 && c <= 47) || (c >= 100 && c <= 107)) {
+                        groups[Background] = std::to_string(c);
+                    } else if(c == 39) {
+                        groups[Foreground].clear();
+                    } else if(c == 49) {
+                        groups[Background].clear();
+                    } else if(c == 1 || c == 2) {
+                        groups[Intensity] = std::to_string(c);
+                    } else if(c == 22) {
+                        groups[Intensity].clear();
+                    } else if(c >= 3 && c <= 9 && c != 6) {
+                        groups[Italic + (c - 3) - (c > 6 ? 1 : 0)] = std::to_string(c);
+                    } else if(c >= 23 && c <= 29 && c != 26) {
+                        groups[Italic + (c - 23) - (c > 26 ? 1 : 0)].clear();
+                    }
+                }
+            }
+
+            std::string str() const {
+                std::string params;
+                for(const auto &g : groups) {
+                    if(g.empty()) continue;
+                    if(!params.empty()) params.push_back(';');
+                    params += g;
+                }
+                return params.empty() ? params : "\x1b[" + params + "m";
+            }
+        };
+
+        bool isSpace(char c) {
+            return c == ' ' || c == '\t';
+        }
+
+        struct LineBuilder {
+            const WrapOptions &options;
+            std::vector<std::string> &out;
+            std::string line;
+            std::size_t used = 0, avail = 1;
+
+            void begin(int indent) {
+                indent = std::clamp(indent, 0, std::max(options.width - 1, 0));
+                line.assign(indent, ' ');
+                used = 0;
+                avail = std::max(options.width - indent, 1);
+            }
+
+            void finish() {
+                out.push_back(std::move(line));
+                line.clear();
+                begin(options.hangingIndent);
+            }
+
+            // Places a word that doesn't fit on any line by itself, breaking it between units.
+            void breakWord(std::string_view word) {
+                std::size_t pos = 0;
+                while(pos < word.size()) {
+                    int w;
+                    auto len = nextUnit(word, pos, w);
+                    if(used && used + w > avail) finish();
+                    line.append(word.substr(pos, len));
+                    used += w;
+                    pos += len;
+                }
+            }
+        };
+
+        void wrapParagraph(std::string_view para, const WrapOptions &options, std::vector<std::string> &out) {
+            LineBuilder b{options, out};
+            b.begin(options.indent);
+
+            std::size_t pos = 0, gapWidth = 0;
+            std::string_view gap;
+
+            while(pos < para.size()) {
+                if(isSpace(para[pos])) {
+                    auto start = pos;
+                    while(pos < para.size() && isSpace(para[pos])) pos++;
+                    gap = para.substr(start, pos - start);
+                    gapWidth = gap.size();
+                    continue;
+                }
+
+                auto start = pos;
+                std::size_t wordWidth = 0;
+                while(pos < para.size() && !isSpace(para[pos])) {
+                    int w;
+                    pos += nextUnit(para, pos, w);
+                    wordWidth += w;
+                }
+                auto word = para.substr(start, pos - start);
+
+                if(b.used + gapWidth + wordWidth <= b.avail) {
+                    for(auto c : gap) b.line.push_back(c == '\t' ? ' ' : c);
+                    b.line.append(word);
+                    b.used += gapWidth + wordWidth;
+                } else {
+                    // Whitespace at a wrap point is dropped.
+                    if(b.used) b.finish();
+                    if(wordWidth <= b.avail) {
+                        b.line.append(word);
+                        b.used += wordWidth;
+                    } else {
+                        b.breakWord(word);
+                    }
+                }
+                gap = {};
+                gapWidth = 0;
+            }
+            // a paragraph with no words is a blank line, not a line of indentation.
+            if(b.line.find_first_not_of(' ') == std::string::npos) b.line.clear();
+            out.push_back(std::move(b.line));
+        }
+    }
+
+    std::size_t escapeLength(std::string_view txt, std::size_t pos) {
+        if(pos >= txt.size() || txt[pos] != '\x1b') return 0;
+        if(pos + 1 >= txt.size()) return 1;
+        auto end = pos + 2;
+        switch(txt[pos + 1]) {
+            case '[':
+                // CSI: parameter and intermediate bytes, then a final byte in 0x40-0x7E.
+                while(end < txt.size()) {
+                    auto c = static_cast<unsigned char>(txt[end++]);
+                    if(c >= 0x40 && c <= 0x7E) return end - pos;
+                }
+                return end - pos;
+            case ']':
+                // OSC: terminated by BEL or ST (ESC \).
+                while(end < txt.size()) {
+                    if(txt[end] == '\a') return end + 1 - pos;
+                    if(txt[end] == '\x1b' && end + 1 < txt.size() && txt[end + 1] == '\\') return end + 2 - pos;
+                    end++;
+                }
+                return end - pos;
+            default:
+                return 2;
+        }
+    }
+
+    std::size_t displayWidth(std::string_view txt) {
+        std::size_t total = 0, pos = 0;
+        while(pos < txt.size()) {
+            int w;
+            pos += nextUnit(txt, pos, w);
+            total += w;
+        }
+        return total;
+    }
+
+    std::vector<std::string> wrapText(std::string_view txt, const WrapOptions &options) {
+        std::vector<std::string> out;
+        std::size_t start = 0;
+        while(true) {
+            auto nl = txt.find('\n', start);
+            auto para = txt.substr(start, nl == std::string_view::npos ? std::string_view::npos : nl - start);
+            if(!para.empty() && para.back() == '\r') para.remove_suffix(1);
+            wrapParagraph(para, options, out);
+            if(nl == std::string_view::npos) break;
+            start = nl + 1;
+            // a trailing newline ends the last line, it doesn't begin an empty one.
+            if(start == txt.size()) break;
+        }
+        return out;
+    }
+
+    std::vector<std::vector<std::string>> paginate(const std::vector<std::string> &lines, int height, int reserve) {
+        std::vector<std::vector<std::string>> pages;
+        std::size_t per = std::max(height - std::max(reserve, 0), 1);
+        // attributes still active at the end of the previous line, replayed at the top of each new page.
+        SgrState sgr;
+
+        for(std::size_t i = 0; i < lines.size(); i++) {
+            if(i % per == 0) {
+                pages.emplace_back();
+                pages.back().reserve(std::min(per, lines.size() - i));
+            }
+            auto &page = pages.back();
+            page.push_back(page.empty() ? sgr.str() + lines[i] : lines[i]);
+
+            std::string_view line(lines[i]);
+            for(std::size_t pos = 0; pos < line.size(); pos++) {
+                auto len = escapeLength(line, pos);
+                if(!len) continue;
+                auto seq = line.substr(pos, len);
+                if(seq.size() >= 3 && seq[1] == '[' && seq.back() == 'm') {
+                    sgr.apply(seq.substr(2, seq.size() - 3));
+                }
+                pos += len - 1;
+            }
+        }
+        return pages;
+    }
+
+    WrapCache::WrapCache(std::size_t maxMessages) : maxMessages(std::max<std::size_t>(maxMessages, 1)) {
+
+    }
+
+    const std::vector<std::string>& WrapCache::wrap(std::string_view txt, const WrapOptions &options) {
+        auto found = entries.find(txt);
+        if(found == entries.end()) {
+            if(entries.size() >= maxMessages) entries.clear();
+            found = entries.emplace(std::string(txt), std::list<Entry>()).first;
+        }
+        auto &variants = found->second;
+        for(const auto &e : variants) {
+            if(e.options == options) return e.lines;
+        }
+        variants.push_back(Entry{options, wrapText(txt, options)});
+        return variants.back().lines;
+    }
+
+    void WrapCache::clear() {
+        entries.clear();
+    }
+
+    std::size_t WrapCache::size() const {
+        return entries.size();
+    }
+
+}
@@ -0,0 +1,131 @@
+#include "mudtelnet/mudtelnet.h"
+#include "mudtelnet/capture.h"
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <thread>
+
+// Replays a capture file written by SessionRecorder through MudTelnet, either as fast as
+// possible (for benchmarking and profiling) or paced to the original timing.
+//
+// Inbound records go through receiveData(), the same parsing and handling path as live traffic.
+// Outbound records are already encoded, so they are only re-parsed and re-serialized through
+// sendMessage(); the game-facing encoders (sendText, sendMXP, ...) are not exercised.
+
+namespace po = boost::program_options;
+using namespace mudtelnet;
+
+struct ReplaySession {
+    TelnetCapabilities capabilities;
+    MudTelnet telnet;
+    ReplaySession() : telnet(&capabilities) {}
+};
+
+struct ReplayStats {
+    std::size_t records = 0, bytesIn = 0, bytesOut = 0, gameMessages = 0, connections = 0;
+};
+
+static void replayOnce(SessionReplay &replay, bool realTime, double speed, uint64_t maxGap, ReplayStats &stats) {
+    std::map<uint32_t, std::unique_ptr<ReplaySession>> sessions;
+    auto start = std::chrono::steady_clock::now();
+    std::optional<uint64_t> previous;
+    uint64_t offset = 0;
+    CaptureRecord rec;
+
+    replay.rewind();
+    while(replay.next(rec)) {
+        stats.records++;
+        if(realTime) {
+            // Pace by the gap since the previous record, clamped so that idle time, or the wall-clock
+            // gap between separate runs appended to the same file, doesn't stall the replay.
+            if(previous && rec.timestamp > *previous) offset += std::min(rec.timestamp - *previous, maxGap);
+            previous = rec.timestamp;
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(static_cast<int64_t>(offset / speed)));
+        }
+
+        auto &sess = sessions[rec.connection];
+        if(!sess) sess = std::make_unique<ReplaySession>();
+        auto &telnet = sess->telnet;
+
+        if(rec.direction == Inbound) {
+            stats.bytesIn += rec.data.size();
+            telnet.receiveData(rec.data);
+        } else {
+            // Outbound data is already encoded; this measures parse() and toString() only.
+            stats.bytesOut += rec.data.size();
+            auto remaining = rec.data;
+            while(!remaining.empty()) {
+                TelnetMessage msg;
+                auto used = msg.parse(remaining);
+                if(!used) break;
+                remaining.remove_prefix(used);
+                telnet.sendMessage(msg);
+            }
+        }
+        stats.gameMessages += telnet.pendingGameMessages.size();
+        telnet.pendingGameMessages.clear();
+        telnet.outDataBuffer.clear();
+    }
+    stats.connections = std::max(stats.connections, sessions.size());
+}
+
+int main(int argc, char **argv) {
+    po::options_description desc("mudtelnet_replay options");
+    desc.add_options()
+            ("help,h", "show this help")
+            ("file,f", po::value<std::string>(), "capture file to replay")
+            ("realtime,r", "pace records to their original timestamps")
+            ("speed,s", po::value<double>()->default_value(1.0), "timing multiplier for --realtime")
+            ("max-gap,g", po::value<double>()->default_value(5.0), "longest pause in seconds --realtime will reproduce")
+            ("iterations,n", po::value<int>()->default_value(1), "number of passes over the file");
+    po::positional_options_description pos;
+    pos.add("file", 1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+        po::notify(vm);
+    } catch(const po::error &e) {
+        std::cerr << e.what() << std::endl << desc << std::endl;
+        return 1;
+    }
+
+    if(vm.count("help") || !vm.count("file")) {
+        std::cout << desc << std::endl;
+        return vm.count("help") ? 0 : 1;
+    }
+
+    auto path = vm["file"].as<std::string>();
+    SessionReplay replay(path);
+    if(!replay.isOpen()) {
+        std::cerr << "could not open capture file " << path << std::endl;
+        return 1;
+    }
+
+    auto realTime = vm.count("realtime") > 0;
+    auto speed = std::max(vm["speed"].as<double>(), 0.001);
+    auto iterations = std::max(vm["iterations"].as<int>(), 1);
+    auto maxGap = static_cast<uint64_t>(std::max(vm["max-gap"].as<double>(), 0.0) * 1e9);
+
+    ReplayStats stats;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) replayOnce(replay, realTime, speed, maxGap, stats);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto bytes = stats.bytesIn + stats.bytesOut;
+    std::cout << "passes:        " << iterations << std::endl
+              << "records:       " << stats.records << std::endl
+              << "connections:   " << stats.connections << std::endl
+              << "bytes in:      " << stats.bytesIn << std::endl
+              << "bytes out:     " << stats.bytesOut << " (re-parsed only, not re-encoded)" << std::endl
+              << "game messages: " << stats.gameMessages << std::endl
+              << "elapsed:       " << elapsed.count() << "s" << std::endl;
+    if(elapsed.count() > 0) {
+        std::cout << "throughput:    " << (bytes / elapsed.count()) / (1024.0 * 1024.0) << " MiB/s" << std::endl;
+    }
+    return 0;
+}